@@ -0,0 +1,68 @@
+/* vim: set ts=4 sw=4 noet : */
+/*
+   Copyright (c) 2014-2025 Malte Hildingsson, malte (at) afterwi.se
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+ */
+
+#ifndef AW_ONCE_H
+#define AW_ONCE_H
+
+#include "aw-atomic.h"
+#include "aw-thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Blocking once for initializers that take long enough that spinning
+   on atomic_once_init would starve the initializing thread. Threads
+   that lose the race spin briefly and then park on the once word.
+   The initializer either commits with thread_once_end or gives up
+   with thread_once_fail, which lets the next caller retry.
+ */
+
+#define THREAD_ONCE_IDLE 0
+#define THREAD_ONCE_BUSY 1
+#define THREAD_ONCE_WAIT 2
+#define THREAD_ONCE_DONE 3
+
+typedef int thread_once_t;
+
+_thread_api bool _thread_once_wait(thread_once_t *once);
+
+_atomic_alwaysinline
+static bool thread_once_init(thread_once_t *once) {
+	if (*(volatile thread_once_t *) once == THREAD_ONCE_DONE) {
+		_atomic_acquire();
+		return false;
+	}
+	return _thread_once_wait(once);
+}
+
+_thread_api void thread_once_end(thread_once_t *once);
+_thread_api void thread_once_fail(thread_once_t *once);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AW_ONCE_H */
+
@@ -0,0 +1,324 @@
+
+/*
+   Copyright (c) 2014-2025 Malte Hildingsson, malte (at) afterwi.se
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+ */
+
+#include "aw-parallel.h"
+#include "aw-atomic.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PARALLEL_STACK_SIZE
+# define PARALLEL_STACK_SIZE 65536
+#endif
+
+#ifndef PARALLEL_CACHE_LINE
+# define PARALLEL_CACHE_LINE 64
+#endif
+
+/* Most chunks a deterministic reduction or scan is split into. */
+#ifndef PARALLEL_CHUNKS
+# define PARALLEL_CHUNKS 256
+#endif
+
+struct parallel_job;
+
+typedef void (_parallel_kernel_t)(
+	const struct parallel_job *job, size_t begin, size_t end, unsigned index);
+
+/* The cursor is written on every grab, so keep it off the line the rest is read from. */
+
+struct parallel_job {
+	volatile long long cursor;
+	char pad[PARALLEL_CACHE_LINE];
+	size_t count;
+	size_t grain;
+	unsigned threads;
+	_parallel_kernel_t *kernel;
+	parallel_for_t *body;
+	parallel_reduce_t *reduce;
+	parallel_scan_t *scan;
+	uintptr_t user_data;
+	char *partials;
+	size_t stride;
+	bool per_chunk;
+	bool final;
+};
+
+struct parallel_worker {
+	struct parallel_pool *pool;
+	unsigned index;
+	thread_id_t thread;
+};
+
+struct parallel_pool {
+	int size;
+	bool quit;
+	sema_id_t start;
+	sema_id_t done;
+	struct parallel_job *job;
+	struct parallel_worker *workers;
+	void *scratch;
+	size_t scratch_size;
+};
+
+static bool _parallel_grab(
+		struct parallel_job *job, long long count, long long grain, long long threads,
+		size_t *begin, size_t *end) {
+	long long c, n, prev;
+
+	if (grain != 0) {
+		if ((c = _atomic_add64(&job->cursor, grain)) >= count)
+			return false;
+		n = grain;
+	} else {
+		/* May tear on 32-bit targets; the CAS validates it before it is used. */
+		for (c = job->cursor;; c = prev) {
+			if (c >= count)
+				n = 0;
+			else if ((n = (count - c) / (2 * threads)) < 1)
+				n = 1;
+			if ((prev = _atomic_cas64(&job->cursor, c, c + n)) == c)
+				break;
+		}
+		if (c >= count)
+			return false;
+	}
+
+	*begin = (size_t) c;
+	*end = (size_t) (c + n < count ? c + n : count);
+	return true;
+}
+
+static void _parallel_run(struct parallel_job *job, unsigned index) {
+	const long long count = (long long) job->count;
+	const long long grain = (long long) job->grain;
+	const long long threads = (long long) job->threads;
+	_parallel_kernel_t *const kernel = job->kernel;
+	size_t begin, end;
+
+	while (_parallel_grab(job, count, grain, threads, &begin, &end))
+		(*kernel)(job, begin, end, index);
+}
+
+static void _parallel_worker(uintptr_t user_data) {
+	struct parallel_worker *worker = (struct parallel_worker *) user_data;
+	struct parallel_pool *pool = worker->pool;
+
+	for (;;) {
+		sema_acquire(pool->start, 1);
+		if (pool->quit)
+			break;
+		_parallel_run(pool->job, worker->index);
+		sema_release(pool->done, 1);
+	}
+
+	thread_exit();
+}
+
+static void _parallel_execute(struct parallel_pool *pool, struct parallel_job *job) {
+	size_t chunks = job->grain != 0 ? (job->count + job->grain - 1) / job->grain : job->count;
+	unsigned wake = (unsigned) (pool->size - 1);
+
+	job->cursor = 0;
+	job->threads = (unsigned) pool->size;
+
+	if (chunks <= wake)
+		wake = chunks > 0 ? (unsigned) (chunks - 1) : 0;
+
+	pool->job = job;
+	sema_release(pool->start, wake);
+	_parallel_run(job, 0);
+	sema_acquire(pool->done, wake);
+}
+
+/* Fixed chunking that bounds the number of partials at PARALLEL_CHUNKS. */
+static size_t _parallel_chunk(size_t count, size_t grain) {
+	const size_t min = (count + PARALLEL_CHUNKS - 1) / PARALLEL_CHUNKS;
+
+	if (grain < min)
+		grain = min;
+	return grain > 0 ? grain : 1;
+}
+
+static char *_parallel_scratch(struct parallel_pool *pool, size_t size) {
+	if (size > pool->scratch_size) {
+		free(pool->scratch);
+		if ((pool->scratch = malloc(size + PARALLEL_CACHE_LINE - 1)) == NULL)
+			abort();
+		pool->scratch_size = size;
+	}
+	return (char *) (((uintptr_t) pool->scratch + PARALLEL_CACHE_LINE - 1) & ~(uintptr_t) (PARALLEL_CACHE_LINE - 1));
+}
+
+static void _parallel_for_kernel(const struct parallel_job *job, size_t begin, size_t end, unsigned index) {
+	(void) index;
+	(*job->body)(begin, end, job->user_data);
+}
+
+static void _parallel_reduce_kernel(const struct parallel_job *job, size_t begin, size_t end, unsigned index) {
+	const size_t slot = job->per_chunk ? begin / job->grain : index;
+	(*job->reduce)(begin, end, job->partials + slot * job->stride, job->user_data);
+}
+
+static void _parallel_scan_kernel(const struct parallel_job *job, size_t begin, size_t end, unsigned index) {
+	(void) index;
+	(*job->scan)(begin, end, job->partials + begin / job->grain * job->stride, job->final, job->user_data);
+}
+
+parallel_pool_id_t parallel_pool_create(int thread_count, enum thread_priority priority) {
+	struct parallel_pool *pool = (struct parallel_pool *) calloc(1, sizeof (struct parallel_pool));
+	int i;
+
+	pool->size = thread_count > 0 ? thread_count : thread_hardware_concurrency();
+	pool->start = sema_create();
+	pool->done = sema_create();
+	pool->workers = (struct parallel_worker *) calloc(pool->size, sizeof (struct parallel_worker));
+
+	for (i = 1; i < pool->size; ++i) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = (unsigned) i;
+		pool->workers[i].thread = thread_spawn(
+			&_parallel_worker, priority, THREAD_NO_AFFINITY, PARALLEL_STACK_SIZE,
+			(uintptr_t) &pool->workers[i], "parallel");
+	}
+
+	return (parallel_pool_id_t) pool;
+}
+
+void parallel_pool_destroy(parallel_pool_id_t id) {
+	struct parallel_pool *pool = (struct parallel_pool *) id;
+	int i;
+
+	pool->quit = true;
+	sema_release(pool->start, (unsigned) (pool->size - 1));
+
+	for (i = 1; i < pool->size; ++i)
+		thread_join(pool->workers[i].thread);
+
+	sema_destroy(pool->start);
+	sema_destroy(pool->done);
+	free(pool->workers);
+	free(pool->scratch);
+	free(pool);
+}
+
+int parallel_pool_size(parallel_pool_id_t id) {
+	return ((struct parallel_pool *) id)->size;
+}
+
+void parallel_for(
+		parallel_pool_id_t id, size_t count, size_t grain,
+		parallel_for_t *body, uintptr_t user_data) {
+	struct parallel_job job;
+
+	memset(&job, 0, sizeof job);
+	job.count = count;
+	job.grain = grain;
+	job.kernel = &_parallel_for_kernel;
+	job.body = body;
+	job.user_data = user_data;
+
+	_parallel_execute((struct parallel_pool *) id, &job);
+}
+
+void parallel_reduce(
+		parallel_pool_id_t id, size_t count, size_t grain,
+		void *result, size_t size, const void *identity,
+		parallel_reduce_t *body, parallel_combine_t *combine,
+		uintptr_t user_data, unsigned flags) {
+	struct parallel_pool *pool = (struct parallel_pool *) id;
+	struct parallel_job job;
+	size_t slots, i;
+
+	memset(&job, 0, sizeof job);
+	job.count = count;
+	job.kernel = &_parallel_reduce_kernel;
+	job.reduce = body;
+	job.user_data = user_data;
+	job.stride = (size + PARALLEL_CACHE_LINE - 1) & ~(size_t) (PARALLEL_CACHE_LINE - 1);
+
+	if ((job.per_chunk = (flags & PARALLEL_DETERMINISTIC) != 0)) {
+		job.grain = _parallel_chunk(count, grain);
+		slots = (count + job.grain - 1) / job.grain;
+	} else {
+		job.grain = grain;
+		slots = (size_t) pool->size;
+	}
+
+	job.partials = _parallel_scratch(pool, slots * job.stride);
+	for (i = 0; i < slots; ++i)
+		memcpy(job.partials + i * job.stride, identity, size);
+
+	_parallel_execute(pool, &job);
+
+	memcpy(result, identity, size);
+	for (i = 0; i < slots; ++i)
+		(*combine)(result, job.partials + i * job.stride, user_data);
+}
+
+void parallel_scan(
+		parallel_pool_id_t id, size_t count, size_t grain,
+		void *result, size_t size, const void *identity,
+		parallel_scan_t *body, parallel_combine_t *combine,
+		uintptr_t user_data) {
+	struct parallel_pool *pool = (struct parallel_pool *) id;
+	struct parallel_job job;
+	size_t chunks, i;
+	char *partial, *tmp;
+
+	memcpy(result, identity, size);
+
+	memset(&job, 0, sizeof job);
+	job.count = count;
+	job.grain = _parallel_chunk(count, grain);
+	job.kernel = &_parallel_scan_kernel;
+	job.scan = body;
+	job.user_data = user_data;
+	job.stride = (size + PARALLEL_CACHE_LINE - 1) & ~(size_t) (PARALLEL_CACHE_LINE - 1);
+
+	if (pool->size == 1 || (chunks = (count + job.grain - 1) / job.grain) <= 1) {
+		if (count > 0)
+			(*body)(0, count, result, true, user_data);
+		return;
+	}
+
+	/* Sum each chunk, turn the sums into exclusive prefixes, then rescan. */
+
+	job.partials = _parallel_scratch(pool, (chunks + 1) * job.stride);
+	tmp = job.partials + chunks * job.stride;
+	for (i = 0; i < chunks; ++i)
+		memcpy(job.partials + i * job.stride, identity, size);
+
+	_parallel_execute(pool, &job);
+
+	for (i = 0; i < chunks; ++i) {
+		partial = job.partials + i * job.stride;
+		memcpy(tmp, partial, size);
+		memcpy(partial, result, size);
+		(*combine)(result, tmp, user_data);
+	}
+
+	job.final = true;
+	_parallel_execute(pool, &job);
+}
+
@@ -0,0 +1,94 @@
+/* vim: set ts=4 sw=4 noet : */
+/*
+   Copyright (c) 2014-2025 Malte Hildingsson, malte (at) afterwi.se
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+ */
+
+#ifndef AW_PARALLEL_H
+#define AW_PARALLEL_H
+
+#include "aw-thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Data-parallel loops over a persistent pool of worker threads. The
+   calling thread takes part in every loop, so a pool of thread_count
+   threads spawns thread_count - 1 workers. A pool runs one loop at a
+   time, so callers sharing a pool must serialize, and bodies must not
+   start loops on the pool they run on.
+
+   Ranges are handed out in chunks from a shared cursor. A grain of zero
+   picks chunk sizes automatically, shrinking them as the range drains
+   so that irregular work stays balanced without paying for tiny chunks
+   up front. A non-zero grain fixes the chunk size.
+
+   Reductions and scans work on opaque values of size bytes. The body
+   folds a range into the value it is given, and combine folds src into
+   dst where dst holds the elements to the left of src. Reductions keep
+   one cache-line padded partial per thread unless PARALLEL_DETERMINISTIC
+   is passed, in which case the range is split into chunks that depend
+   only on count and grain, and the partials are combined left to right.
+   Scans are always deterministic. Both raise the grain as needed so the
+   range splits into at most PARALLEL_CHUNKS (256 by default) chunks.
+ */
+
+#define PARALLEL_DETERMINISTIC (1u << 0)
+
+typedef uintptr_t parallel_pool_id_t;
+
+typedef void (parallel_for_t)(size_t begin, size_t end, uintptr_t user_data);
+typedef void (parallel_reduce_t)(size_t begin, size_t end, void *value, uintptr_t user_data);
+typedef void (parallel_combine_t)(void *dst, const void *src, uintptr_t user_data);
+
+/* The body writes its outputs only when final is true. */
+typedef void (parallel_scan_t)(
+	size_t begin, size_t end, void *value, bool final, uintptr_t user_data);
+
+/* A thread_count of zero uses thread_hardware_concurrency. */
+_thread_api parallel_pool_id_t parallel_pool_create(int thread_count, enum thread_priority priority);
+_thread_api void parallel_pool_destroy(parallel_pool_id_t id);
+
+_thread_api int parallel_pool_size(parallel_pool_id_t id);
+
+_thread_api void parallel_for(
+	parallel_pool_id_t id, size_t count, size_t grain,
+	parallel_for_t *body, uintptr_t user_data);
+
+_thread_api void parallel_reduce(
+	parallel_pool_id_t id, size_t count, size_t grain,
+	void *result, size_t size, const void *identity,
+	parallel_reduce_t *body, parallel_combine_t *combine,
+	uintptr_t user_data, unsigned flags);
+
+_thread_api void parallel_scan(
+	parallel_pool_id_t id, size_t count, size_t grain,
+	void *result, size_t size, const void *identity,
+	parallel_scan_t *body, parallel_combine_t *combine,
+	uintptr_t user_data);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AW_PARALLEL_H */
+
@@ -36,6 +36,7 @@
 #endif /* _thread_nofeatures */
 
 #include "aw-thread.h"
+#include "aw-once.h"
 
 #if defined(_WIN32)
 # include <windows.h>
@@ -49,6 +50,17 @@
 # include <semaphore.h>
 #endif
 
+/* Wait against CLOCK_MONOTONIC where possible so wall clock steps cannot stretch timeouts. */
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+# define _thread_sem_clockwait 1
+#endif
+
+#if defined(__linux__)
+# include <limits.h>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+
 #if defined(__APPLE__) || defined(__linux__) || defined(__SCE__) || defined(__NINTENDO__)
 # include <errno.h>
 # include <pthread.h>
@@ -57,6 +69,7 @@
 # endif
 # include <sched.h>
 # include <sys/types.h>
+# include <time.h>
 # include <unistd.h>
 #endif
 
@@ -73,6 +86,17 @@ kern_return_t thread_policy_get(
 	thread_t thread, thread_policy_flavor_t flavor,
 	thread_policy_t policy_info, mach_msg_type_number_t *count,
 	boolean_t *get_default);
+
+/* from bsd/sys/ulock.h */
+int __ulock_wait(uint32_t operation, void *addr, uint64_t value, uint32_t timeout);
+int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
+# define UL_COMPARE_AND_WAIT 1
+# define ULF_WAKE_ALL 0x100
+# define ULF_NO_ERRNO 0x1000000
+#endif
+
+#if defined(_MSC_VER)
+# pragma comment(lib, "synchronization.lib")
 #endif
 
 int thread_hardware_concurrency() {
@@ -339,3 +363,112 @@ void sema_release(sema_id_t id, unsigned count) {
 #endif
 }
 
+bool sema_acquire_timeout(sema_id_t id, uint64_t timeout_ns) {
+#if defined(_WIN32)
+	uint64_t ms = timeout_ns / 1000000 + (timeout_ns % 1000000 != 0);
+	ms = ms < INFINITE ? ms : INFINITE - 1;
+	return WaitForSingleObject((HANDLE) id, (DWORD) ms) == WAIT_OBJECT_0;
+#elif defined(__APPLE__)
+	mach_timespec_t ts;
+	ts.tv_sec = (unsigned) (timeout_ns / 1000000000);
+	ts.tv_nsec = (clock_res_t) (timeout_ns % 1000000000);
+	return semaphore_timedwait(id, ts) == KERN_SUCCESS;
+#elif defined(__linux__) || defined(__SCE__) || defined(__NINTENDO__)
+	struct timespec ts;
+	int err;
+
+# if defined(_thread_sem_clockwait)
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+# else
+	clock_gettime(CLOCK_REALTIME, &ts);
+# endif
+	ts.tv_sec += (time_t) (timeout_ns / 1000000000);
+	ts.tv_nsec += (long) (timeout_ns % 1000000000);
+	if (ts.tv_nsec >= 1000000000)
+		ts.tv_sec += 1, ts.tv_nsec -= 1000000000;
+
+# if defined(_thread_sem_clockwait)
+	while ((err = sem_clockwait((sem_t *) id, CLOCK_MONOTONIC, &ts)) < 0 && errno == EINTR)
+		;
+# else
+	while ((err = sem_timedwait((sem_t *) id, &ts)) < 0 && errno == EINTR)
+		;
+# endif
+	if (err < 0 && errno != ETIMEDOUT)
+		abort();
+	return err == 0;
+#endif
+}
+
+#ifndef THREAD_ONCE_SPIN
+# define THREAD_ONCE_SPIN 100
+#endif
+
+static void _thread_park(thread_once_t *addr, thread_once_t val) {
+#if defined(_WIN32)
+	WaitOnAddress(addr, &val, sizeof val, INFINITE);
+#elif defined(__APPLE__)
+	__ulock_wait(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, addr, (uint64_t) val, 0);
+#elif defined(__linux__)
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#elif defined(__SCE__) || defined(__NINTENDO__)
+	if (*(volatile thread_once_t *) addr == val)
+		sched_yield();
+#endif
+}
+
+static void _thread_unpark_all(thread_once_t *addr) {
+#if defined(_WIN32)
+	WakeByAddressAll(addr);
+#elif defined(__APPLE__)
+	__ulock_wake(UL_COMPARE_AND_WAIT | ULF_WAKE_ALL | ULF_NO_ERRNO, addr, 0);
+#elif defined(__linux__)
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+	(void) addr;
+#endif
+}
+
+static thread_once_t _thread_once_set(thread_once_t *once, thread_once_t val) {
+	thread_once_t state;
+
+	do state = *(volatile thread_once_t *) once;
+	while (_atomic_cas32(once, state, val) != state);
+	return state;
+}
+
+bool _thread_once_wait(thread_once_t *once) {
+	thread_once_t state;
+	int spin;
+
+	for (;;) {
+		if ((state = _atomic_cas32(once, THREAD_ONCE_IDLE, THREAD_ONCE_BUSY)) == THREAD_ONCE_IDLE)
+			return true;
+
+		for (spin = 0; state == THREAD_ONCE_BUSY && spin < THREAD_ONCE_SPIN; ++spin) {
+			_atomic_yield();
+			state = *(volatile thread_once_t *) once;
+		}
+
+		if (state == THREAD_ONCE_DONE) {
+			_atomic_acquire();
+			return false;
+		}
+
+		if (state == THREAD_ONCE_BUSY)
+			state = _atomic_cas32(once, THREAD_ONCE_BUSY, THREAD_ONCE_WAIT);
+		if (state != THREAD_ONCE_IDLE && state != THREAD_ONCE_DONE)
+			_thread_park(once, THREAD_ONCE_WAIT);
+	}
+}
+
+void thread_once_end(thread_once_t *once) {
+	if (_thread_once_set(once, THREAD_ONCE_DONE) == THREAD_ONCE_WAIT)
+		_thread_unpark_all(once);
+}
+
+void thread_once_fail(thread_once_t *once) {
+	if (_thread_once_set(once, THREAD_ONCE_IDLE) == THREAD_ONCE_WAIT)
+		_thread_unpark_all(once);
+}
+
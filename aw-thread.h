@@ -30,6 +30,10 @@
 # include <stdint.h>
 #endif
 
+#if !defined(_MSC_VER) || _MSC_VER >= 1800
+# include <stdbool.h>
+#endif
+
 #if defined(_thread_dllexport)
 # if defined(_MSC_VER)
 #  define _thread_api extern __declspec(dllexport)
@@ -80,6 +84,9 @@ _thread_api void sema_destroy(sema_id_t id);
 _thread_api void sema_acquire(sema_id_t id, unsigned count);
 _thread_api void sema_release(sema_id_t id, unsigned count);
 
+/* Returns false if the semaphore could not be acquired within timeout_ns. */
+_thread_api bool sema_acquire_timeout(sema_id_t id, uint64_t timeout_ns);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,346 @@
+
+/*
+   Copyright (c) 2014-2025 Malte Hildingsson, malte (at) afterwi.se
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+ */
+
+#ifndef _thread_nofeatures
+# if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN 1
+# elif defined(__linux__) || defined(__NINTENDO__)
+#  define _BSD_SOURCE 1
+#  define _GNU_SOURCE 1
+#  define _DEFAULT_SOURCE 1
+#  define _POSIX_C_SOURCE 200809L
+#  define _SVID_SOURCE 1
+# elif defined(__APPLE__)
+#  define _DARWIN_C_SOURCE 1
+# endif
+#endif /* _thread_nofeatures */
+
+#include "aw-timer.h"
+#include "aw-atomic.h"
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TIMER_STACK_SIZE
+# define TIMER_STACK_SIZE 65536
+#endif
+
+/*
+   Six levels of 64 slots, i.e. 2^36 ticks or about two years at a
+   millisecond resolution. Timers further out than that are parked in
+   the last level and cascade back into it until they come within range.
+ */
+
+#define TIMER_LEVEL_BITS 6
+#define TIMER_LEVEL_SIZE (1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SIZE - 1)
+#define TIMER_LEVELS 6
+#define TIMER_MAX_DELTA ((UINT64_C(1) << (TIMER_LEVEL_BITS * TIMER_LEVELS)) - 1)
+
+struct timer_wheel {
+	atomic_spin_t lock;
+	bool quit;
+	uint64_t now;
+	uint64_t sleep_until;
+	uint64_t origin;
+	uint64_t resolution;
+	struct atomic_ring *ring;
+	sema_id_t sema;
+	sema_id_t wake;
+	thread_id_t thread;
+	uint64_t occupied[TIMER_LEVELS];
+	struct timer *slots[TIMER_LEVELS * TIMER_LEVEL_SIZE];
+};
+
+static uint64_t _timer_clock(void) {
+#if defined(_WIN32)
+	LARGE_INTEGER c, f;
+	QueryPerformanceCounter(&c);
+	QueryPerformanceFrequency(&f);
+	return (uint64_t) (c.QuadPart / f.QuadPart) * 1000000000 +
+		(uint64_t) (c.QuadPart % f.QuadPart) * 1000000000 / f.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static unsigned _timer_ctz(uint64_t x) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return i;
+#elif defined(_MSC_VER)
+	unsigned long i;
+	if (_BitScanForward(&i, (unsigned long) x))
+		return i;
+	_BitScanForward(&i, (unsigned long) (x >> 32));
+	return i + 32;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+static uint64_t _timer_rotr(uint64_t x, unsigned n) {
+	return n ? (x >> n) | (x << (64 - n)) : x;
+}
+
+/* Round up to the coarsest boundary within the slack so timers coalesce. */
+static uint64_t _timer_slack(uint64_t expires, uint64_t slack) {
+	uint64_t limit = expires + slack, mask = (expires - 1) ^ limit;
+
+	if (slack == 0 || expires == 0)
+		return expires;
+
+	while (mask & (mask - 1))
+		mask &= mask - 1;
+	return limit & ~(mask - 1);
+}
+
+static void _timer_link(struct timer_wheel *wheel, struct timer *timer) {
+	uint64_t expires = timer->expires, delta;
+	unsigned level, index;
+
+	if (expires < wheel->now)
+		expires = wheel->now;
+	if ((delta = expires - wheel->now) > TIMER_MAX_DELTA)
+		delta = TIMER_MAX_DELTA, expires = wheel->now + delta;
+
+	for (level = 0; (delta >> (TIMER_LEVEL_BITS * (level + 1))) != 0; ++level)
+		;
+	index = (expires >> (TIMER_LEVEL_BITS * level)) & TIMER_LEVEL_MASK;
+
+	timer->slot = level * TIMER_LEVEL_SIZE + index;
+	timer->pprev = &wheel->slots[timer->slot];
+	if ((timer->next = *timer->pprev) != NULL)
+		timer->next->pprev = &timer->next;
+	*timer->pprev = timer;
+	wheel->occupied[level] |= UINT64_C(1) << index;
+}
+
+static void _timer_unlink(struct timer_wheel *wheel, struct timer *timer) {
+	const unsigned slot = timer->slot;
+
+	if ((*timer->pprev = timer->next) != NULL)
+		timer->next->pprev = timer->pprev;
+	if (wheel->slots[slot] == NULL)
+		wheel->occupied[slot / TIMER_LEVEL_SIZE] &= ~(UINT64_C(1) << (slot & TIMER_LEVEL_MASK));
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->slot = TIMER_NOT_PENDING;
+}
+
+static void _timer_cascade(struct timer_wheel *wheel, unsigned level, unsigned index) {
+	struct timer *timer = wheel->slots[level * TIMER_LEVEL_SIZE + index], *next;
+
+	wheel->slots[level * TIMER_LEVEL_SIZE + index] = NULL;
+	wheel->occupied[level] &= ~(UINT64_C(1) << index);
+
+	for (; timer != NULL; timer = next) {
+		next = timer->next;
+		_timer_link(wheel, timer);
+	}
+}
+
+/* Earliest tick at which a timer expires or a slot cascades. */
+static uint64_t _timer_next(const struct timer_wheel *wheel) {
+	uint64_t next = UINT64_MAX, base, tick;
+	unsigned level, shift;
+
+	for (level = 0; level < TIMER_LEVELS; ++level) {
+		if (wheel->occupied[level] == 0)
+			continue;
+		shift = TIMER_LEVEL_BITS * level;
+		base = (wheel->now + (UINT64_C(1) << shift) - 1) >> shift;
+		base += _timer_ctz(_timer_rotr(wheel->occupied[level], base & TIMER_LEVEL_MASK));
+		if ((tick = base << shift) < next)
+			next = tick;
+	}
+
+	return next;
+}
+
+static void _timer_dispatch(struct timer_wheel *wheel, const struct timer_event *event) {
+	if (wheel->ring == NULL) {
+		(*event->callback)(event->user_data);
+		return;
+	}
+
+	while (!atomic_enqueue(wheel->ring, event, sizeof *event))
+		thread_yield();
+	sema_release(wheel->sema, 1);
+}
+
+static void _timer_tick(struct timer_wheel *wheel) {
+	const uint64_t now = wheel->now;
+	const unsigned index = now & TIMER_LEVEL_MASK;
+	struct timer_event event;
+	struct timer *timer;
+	unsigned level, i;
+
+	if (index == 0)
+		for (level = 1; level < TIMER_LEVELS; ++level) {
+			_timer_cascade(wheel, level, i = (now >> (TIMER_LEVEL_BITS * level)) & TIMER_LEVEL_MASK);
+			if (i != 0)
+				break;
+		}
+
+	while ((timer = wheel->slots[index]) != NULL) {
+		_timer_unlink(wheel, timer);
+		event.callback = timer->callback;
+		event.user_data = timer->user_data;
+
+		if (timer->period != 0) {
+			if ((timer->deadline += timer->period) <= now)
+				timer->deadline = now + 1;
+			timer->expires = _timer_slack(timer->deadline, timer->slack);
+			_timer_link(wheel, timer);
+		}
+
+		atomic_unlock(&wheel->lock);
+		_timer_dispatch(wheel, &event);
+		atomic_lock(&wheel->lock);
+	}
+
+	wheel->now = now + 1;
+}
+
+static void _timer_thread(uintptr_t user_data) {
+	struct timer_wheel *wheel = (struct timer_wheel *) user_data;
+	uint64_t tick, next, now_ns, wake;
+
+	atomic_lock(&wheel->lock);
+
+	while (!wheel->quit) {
+		tick = (_timer_clock() - wheel->origin) / wheel->resolution;
+
+		while ((next = _timer_next(wheel)) <= tick) {
+			wheel->now = next;
+			_timer_tick(wheel);
+		}
+		if (wheel->now <= tick)
+			wheel->now = tick + 1;
+
+		wheel->sleep_until = next;
+		atomic_unlock(&wheel->lock);
+
+		if (next == UINT64_MAX)
+			sema_acquire(wheel->wake, 1);
+		else
+			for (wake = wheel->origin + next * wheel->resolution;
+					(now_ns = _timer_clock()) < wake && !sema_acquire_timeout(wheel->wake, wake - now_ns);)
+				;
+
+		atomic_lock(&wheel->lock);
+		wheel->sleep_until = 0;
+	}
+
+	atomic_unlock(&wheel->lock);
+}
+
+void timer_init(struct timer *timer, timer_callback_t *callback, uintptr_t user_data) {
+	memset(timer, 0, sizeof *timer);
+	timer->callback = callback;
+	timer->user_data = user_data;
+	timer->slot = TIMER_NOT_PENDING;
+}
+
+timer_wheel_id_t timer_wheel_create(
+		uint64_t resolution_ns, struct atomic_ring *ring, sema_id_t sema,
+		enum thread_priority priority, int affinity, const char *name) {
+	struct timer_wheel *wheel = (struct timer_wheel *) calloc(1, sizeof (struct timer_wheel));
+
+	_atomic_assert(resolution_ns > 0);
+
+	wheel->origin = _timer_clock();
+	wheel->resolution = resolution_ns;
+	wheel->ring = ring;
+	wheel->sema = sema;
+	wheel->wake = sema_create();
+	wheel->thread = thread_spawn(
+		&_timer_thread, priority, affinity, TIMER_STACK_SIZE, (uintptr_t) wheel, name);
+
+	return (timer_wheel_id_t) wheel;
+}
+
+void timer_wheel_destroy(timer_wheel_id_t id) {
+	struct timer_wheel *wheel = (struct timer_wheel *) id;
+
+	atomic_lock(&wheel->lock);
+	wheel->quit = true;
+	atomic_unlock(&wheel->lock);
+
+	sema_release(wheel->wake, 1);
+	thread_join(wheel->thread);
+	sema_destroy(wheel->wake);
+	free(wheel);
+}
+
+void timer_schedule(
+		timer_wheel_id_t id, struct timer *timer,
+		uint64_t delay_ns, uint64_t period_ns, uint64_t slack_ns) {
+	struct timer_wheel *wheel = (struct timer_wheel *) id;
+	const uint64_t res = wheel->resolution;
+	const uint64_t deadline = (_timer_clock() - wheel->origin + delay_ns + res - 1) / res;
+	bool wake;
+
+	atomic_lock(&wheel->lock);
+
+	if (timer->slot != TIMER_NOT_PENDING)
+		_timer_unlink(wheel, timer);
+
+	timer->deadline = deadline;
+	timer->period = (period_ns + res - 1) / res;
+	timer->slack = slack_ns / res;
+	timer->expires = _timer_slack(deadline, timer->slack);
+	_timer_link(wheel, timer);
+
+	if ((wake = timer->expires < wheel->sleep_until))
+		wheel->sleep_until = timer->expires;
+
+	atomic_unlock(&wheel->lock);
+
+	if (wake)
+		sema_release(wheel->wake, 1);
+}
+
+bool timer_cancel(timer_wheel_id_t id, struct timer *timer) {
+	struct timer_wheel *wheel = (struct timer_wheel *) id;
+	bool pending;
+
+	atomic_lock(&wheel->lock);
+	if ((pending = timer->slot != TIMER_NOT_PENDING))
+		_timer_unlink(wheel, timer);
+	atomic_unlock(&wheel->lock);
+
+	return pending;
+}
+
@@ -0,0 +1,96 @@
+/* vim: set ts=4 sw=4 noet : */
+/*
+   Copyright (c) 2014-2025 Malte Hildingsson, malte (at) afterwi.se
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+ */
+
+#ifndef AW_TIMER_H
+#define AW_TIMER_H
+
+#include "aw-thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Hierarchical timing wheel serviced by one dedicated thread. Timers are
+   owned by the caller and linked into the wheel, so scheduling and
+   cancelling are O(1) and never allocate.
+
+   Expired callbacks run on the wheel thread unless a ring is passed to
+   timer_wheel_create, in which case one struct timer_event is enqueued
+   per expiry and the semaphore is released once for it. The wheel thread
+   is the single producer; a worker drains the ring with:
+
+       sema_acquire(sema, 1);
+       atomic_dequeue(ring, &event, sizeof event);
+       (*event.callback)(event.user_data);
+
+   Slack lets the wheel postpone an expiry by up to slack_ns so that
+   nearby timers coalesce into a single wake-up.
+ */
+
+#define TIMER_NOT_PENDING (~0u)
+
+typedef uintptr_t timer_wheel_id_t;
+
+typedef void (timer_callback_t)(uintptr_t user_data);
+
+struct timer {
+	struct timer *next;
+	struct timer **pprev;
+	uint64_t deadline;
+	uint64_t expires;
+	uint64_t period;
+	uint64_t slack;
+	timer_callback_t *callback;
+	uintptr_t user_data;
+	unsigned slot;
+};
+
+struct timer_event {
+	timer_callback_t *callback;
+	uintptr_t user_data;
+};
+
+struct atomic_ring;
+
+_thread_api void timer_init(struct timer *timer, timer_callback_t *callback, uintptr_t user_data);
+
+_thread_api timer_wheel_id_t timer_wheel_create(
+	uint64_t resolution_ns, struct atomic_ring *ring, sema_id_t sema,
+	enum thread_priority priority, int affinity, const char *name);
+_thread_api void timer_wheel_destroy(timer_wheel_id_t id);
+
+/* Arms or re-arms the timer; a non-zero period_ns makes it periodic. */
+_thread_api void timer_schedule(
+	timer_wheel_id_t id, struct timer *timer,
+	uint64_t delay_ns, uint64_t period_ns, uint64_t slack_ns);
+
+/* Returns false if the timer was not pending, e.g. it already expired. */
+_thread_api bool timer_cancel(timer_wheel_id_t id, struct timer *timer);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AW_TIMER_H */
+
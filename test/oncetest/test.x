@@ -0,0 +1,98 @@
+
+#define _POSIX_C_SOURCE 200809L
+#include "aw-once.h"
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+
+#define THREAD_COUNT 32
+#define BENCH_COUNT 50000000
+
+static thread_once_t once;
+static volatile int attempts;
+static volatile int value;
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t cputime(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void tmain(uintptr_t data) {
+	sema_id_t sema = (sema_id_t) data;
+	struct timespec ts = {0, 20000000};
+
+	sema_acquire(sema, 1);
+
+	while (thread_once_init(&once)) {
+		nanosleep(&ts, NULL);
+		if (_atomic_add32(&attempts, 1) == 0) {
+			thread_once_fail(&once);
+			continue;
+		}
+		value = 42;
+		thread_once_end(&once);
+	}
+
+	assert(value == 42);
+	thread_exit();
+}
+
+int main(int argc, char *argv[]) {
+	(void) argc;
+	(void) argv;
+
+	sema_id_t s = sema_create();
+	thread_id_t y[THREAD_COUNT];
+	uint64_t wall, cpu;
+	int i;
+
+	for (i = 0; i < THREAD_COUNT; ++i)
+		y[i] = thread_spawn(&tmain, THREAD_NORMAL_PRIORITY, THREAD_NO_AFFINITY, 65536, (uintptr_t) s, NULL);
+
+	wall = now();
+	cpu = cputime();
+	sema_release(s, THREAD_COUNT);
+
+	for (i = 0; i < THREAD_COUNT; ++i)
+		thread_join(y[i]);
+
+	wall = now() - wall;
+	cpu = cputime() - cpu;
+	sema_destroy(s);
+
+	assert(attempts == 2);
+	assert(value == 42);
+	printf("contended: threads=%d wall=%.1fms cpu=%.1fms\n", THREAD_COUNT, wall / 1e6, cpu / 1e6);
+
+	atomic_once_t a = 0;
+	thread_once_t b = 0;
+	uint64_t t0, t1, t2;
+	int n = 0;
+
+	atomic_once_init(&a);
+	atomic_once_end(&a);
+	thread_once_init(&b);
+	thread_once_end(&b);
+
+	t0 = now();
+	for (i = 0; i < BENCH_COUNT; ++i)
+		n += atomic_once_init(&a);
+	t1 = now();
+	for (i = 0; i < BENCH_COUNT; ++i)
+		n += thread_once_init(&b);
+	t2 = now();
+
+	assert(n == 0);
+	printf("fast path: atomic_once_init=%.2fns thread_once_init=%.2fns\n",
+		(double) (t1 - t0) / BENCH_COUNT, (double) (t2 - t1) / BENCH_COUNT);
+
+	printf("OK\n");
+	return 0;
+}
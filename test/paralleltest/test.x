@@ -0,0 +1,161 @@
+
+#define _POSIX_C_SOURCE 200809L
+#include "aw-parallel.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define COUNT 4000000
+#define BENCH_COUNT 20000000
+
+static int *input;
+static long long *output;
+static double *values;
+static unsigned *work;
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void fill(size_t begin, size_t end, uintptr_t data) {
+	(void) data;
+	for (size_t i = begin; i < end; ++i)
+		input[i] = (int) (i % 7) - 3;
+}
+
+void irregular(size_t begin, size_t end, uintptr_t data) {
+	(void) data;
+	for (size_t i = begin; i < end; ++i) {
+		unsigned x = (unsigned) i | 1;
+		for (size_t j = 0; j < (i >> 4) % 16; ++j)
+			x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+		work[i] = x;
+	}
+}
+
+void sum(size_t begin, size_t end, void *value, uintptr_t data) {
+	long long acc = *(long long *) value;
+	(void) data;
+	for (size_t i = begin; i < end; ++i)
+		acc += input[i];
+	*(long long *) value = acc;
+}
+
+void fsum(size_t begin, size_t end, void *value, uintptr_t data) {
+	double acc = *(double *) value;
+	(void) data;
+	for (size_t i = begin; i < end; ++i)
+		acc += values[i];
+	*(double *) value = acc;
+}
+
+void add(void *dst, const void *src, uintptr_t data) {
+	(void) data;
+	*(long long *) dst += *(const long long *) src;
+}
+
+void fadd(void *dst, const void *src, uintptr_t data) {
+	(void) data;
+	*(double *) dst += *(const double *) src;
+}
+
+void prefix(size_t begin, size_t end, void *value, bool final, uintptr_t data) {
+	long long acc = *(long long *) value;
+	(void) data;
+	for (size_t i = begin; i < end; ++i) {
+		acc += input[i];
+		if (final)
+			output[i] = acc;
+	}
+	*(long long *) value = acc;
+}
+
+static void check(parallel_pool_id_t pool, double *expected) {
+	const long long zero = 0;
+	const double fzero = 0.0;
+	long long total = 0, result, acc = 0;
+	double fresult;
+
+	memset(input, 0, COUNT * sizeof *input);
+	parallel_for(pool, COUNT, 0, &fill, 0);
+	for (size_t i = 0; i < COUNT; ++i)
+		assert(input[i] == (int) (i % 7) - 3), total += input[i];
+
+	memset(input, 0, COUNT * sizeof *input);
+	parallel_for(pool, COUNT, 777, &fill, 0);
+	for (size_t i = 0; i < COUNT; ++i)
+		assert(input[i] == (int) (i % 7) - 3);
+
+	parallel_reduce(pool, COUNT, 0, &result, sizeof result, &zero, &sum, &add, 0, 0);
+	assert(result == total);
+	parallel_reduce(pool, COUNT, 777, &result, sizeof result, &zero, &sum, &add, 0, 0);
+	assert(result == total);
+	parallel_reduce(pool, COUNT, 1000, &result, sizeof result, &zero, &sum, &add, 0, PARALLEL_DETERMINISTIC);
+	assert(result == total);
+	parallel_reduce(pool, 0, 0, &result, sizeof result, &zero, &sum, &add, 0, 0);
+	assert(result == 0);
+
+	parallel_reduce(pool, COUNT, 0, &fresult, sizeof fresult, &fzero, &fsum, &fadd, 0, PARALLEL_DETERMINISTIC);
+	if (*expected == 0.0)
+		*expected = fresult;
+	assert(memcmp(&fresult, expected, sizeof fresult) == 0);
+
+	parallel_scan(pool, COUNT, 0, &result, sizeof result, &zero, &prefix, &add, 0);
+	assert(result == total);
+	for (size_t i = 0; i < COUNT; ++i)
+		acc += input[i], assert(output[i] == acc);
+
+	memset(output, 0, COUNT * sizeof *output);
+	parallel_scan(pool, COUNT, 20001, &result, sizeof result, &zero, &prefix, &add, 0);
+	assert(result == total);
+	acc = 0;
+	for (size_t i = 0; i < COUNT; ++i)
+		acc += input[i], assert(output[i] == acc);
+}
+
+static double bench(parallel_pool_id_t pool, parallel_for_t *body) {
+	uint64_t t = now();
+	parallel_for(pool, BENCH_COUNT, 0, body, 0);
+	return (now() - t) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+	(void) argc;
+	(void) argv;
+
+	int n = thread_hardware_concurrency();
+	double expected = 0.0;
+
+	input = malloc(BENCH_COUNT * sizeof *input);
+	output = malloc(COUNT * sizeof *output);
+	values = malloc(COUNT * sizeof *values);
+	work = malloc(BENCH_COUNT * sizeof *work);
+
+	for (size_t i = 0; i < COUNT; ++i)
+		values[i] = 1.0 / (double) (i + 1);
+
+	for (int threads = 1;; threads = threads * 2 < n ? threads * 2 : n) {
+		parallel_pool_id_t pool = parallel_pool_create(threads, THREAD_NORMAL_PRIORITY);
+		double fill_ms, irregular_ms;
+
+		check(pool, &expected);
+		fill_ms = bench(pool, &fill);
+		irregular_ms = bench(pool, &irregular);
+		printf("threads=%d fill=%.1fms irregular=%.1fms\n", threads, fill_ms, irregular_ms);
+
+		parallel_pool_destroy(pool);
+		if (threads == n)
+			break;
+	}
+
+	parallel_pool_id_t pool = parallel_pool_create(n + 3, THREAD_NORMAL_PRIORITY);
+	check(pool, &expected);
+	parallel_pool_destroy(pool);
+
+	printf("OK\n");
+	return 0;
+}
@@ -41,7 +41,7 @@ int main(int argc, char *argv[]) {
 
 	thread_id_t y[n];
 	for (int i = 0; i < n; ++i)
-		y[i] = thread_spawn(&tmain, THREAD_LOW_PRIORITY, THREAD_NO_AFFINITY, 8192, (uintptr_t) &x[i]);
+		y[i] = thread_spawn(&tmain, THREAD_LOW_PRIORITY, THREAD_NO_AFFINITY, 8192, (uintptr_t) &x[i], NULL);
 
 	sema_release(s, n);
 
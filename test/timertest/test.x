@@ -0,0 +1,149 @@
+
+#define _POSIX_C_SOURCE 200809L
+#include "aw-atomic.h"
+#include "aw-timer.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TIMER_COUNT 200000
+#define MILLISECOND 1000000
+
+/* Scheduling margin on top of slack before a callback counts as late. */
+#define LATENESS (250 * MILLISECOND)
+
+struct tdata {
+	struct timer timer;
+	uint64_t earliest;
+	uint64_t latest;
+};
+
+struct queue {
+	struct atomic_ring ring;
+	sema_id_t sema;
+	char buf[4096];
+};
+
+static struct tdata timers[TIMER_COUNT];
+static volatile int fired;
+static volatile int periodic;
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_ms(int ms) {
+	struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+	nanosleep(&ts, NULL);
+}
+
+void expire(uintptr_t data) {
+	struct tdata *tdata = (struct tdata *) data;
+	uint64_t t = now();
+	assert(t >= tdata->earliest);
+	assert(t <= tdata->latest);
+	_atomic_add32(&fired, 1);
+}
+
+void never(uintptr_t data) {
+	(void) data;
+	assert(!"far timer fired");
+}
+
+void tick(uintptr_t data) {
+	(void) data;
+	_atomic_add32(&periodic, 1);
+}
+
+void worker(uintptr_t data) {
+	struct queue *queue = (struct queue *) data;
+	struct timer_event event;
+
+	for (;;) {
+		sema_acquire(queue->sema, 1);
+		if (!atomic_dequeue(&queue->ring, &event, sizeof event))
+			abort();
+		if (event.callback == NULL)
+			break;
+		(*event.callback)(event.user_data);
+	}
+
+	thread_exit();
+}
+
+static void run(timer_wheel_id_t wheel, uint64_t resolution, uint64_t range) {
+	struct timer tick_timer, far_timer;
+	int i, cancelled = 0;
+
+	fired = 0;
+	periodic = 0;
+
+	for (i = 0; i < TIMER_COUNT; ++i) {
+		uint64_t delay = (((uint64_t) rand() << 16) ^ (uint64_t) rand()) % range;
+		uint64_t slack = (i & 1) * 5 * resolution;
+		timer_init(&timers[i].timer, &expire, (uintptr_t) &timers[i]);
+		timers[i].earliest = now() + delay;
+		timers[i].latest = timers[i].earliest + slack + 4 * resolution + LATENESS;
+		timer_schedule(wheel, &timers[i].timer, delay, 0, slack);
+	}
+
+	for (i = 0; i < TIMER_COUNT; i += 3)
+		cancelled += timer_cancel(wheel, &timers[i].timer);
+
+	timer_init(&tick_timer, &tick, 0);
+	timer_schedule(wheel, &tick_timer, 10 * MILLISECOND, 10 * MILLISECOND, 0);
+
+	/* Beyond the last level, so it is clamped and must never fire. */
+	timer_init(&far_timer, &never, 0);
+	timer_schedule(wheel, &far_timer, resolution << 37, 0, 0);
+
+	for (i = 0; i < 1000 && fired + cancelled < TIMER_COUNT; ++i)
+		sleep_ms(10);
+
+	assert(fired + cancelled == TIMER_COUNT);
+	assert(timer_cancel(wheel, &tick_timer));
+	assert(!timer_cancel(wheel, &tick_timer));
+	assert(periodic >= 5);
+	assert(timer_cancel(wheel, &far_timer));
+
+	printf("run: fired=%d cancelled=%d periodic=%d\n", fired, cancelled, periodic);
+}
+
+int main(int argc, char *argv[]) {
+	(void) argc;
+	(void) argv;
+
+	timer_wheel_id_t wheel;
+
+	wheel = timer_wheel_create(MILLISECOND, NULL, 0, THREAD_NORMAL_PRIORITY, THREAD_NO_AFFINITY, "timer");
+	run(wheel, MILLISECOND, 200 * MILLISECOND);
+	timer_wheel_destroy(wheel);
+
+	/* Microsecond ticks over two seconds reach levels 0-3 and their cascades. */
+	wheel = timer_wheel_create(MILLISECOND / 1000, NULL, 0, THREAD_NORMAL_PRIORITY, THREAD_NO_AFFINITY, "timer");
+	run(wheel, MILLISECOND / 1000, 2000 * MILLISECOND);
+	timer_wheel_destroy(wheel);
+
+	struct queue queue;
+	struct timer_event stop = {NULL, 0};
+
+	queue.sema = sema_create();
+	atomic_ring_init(&queue.ring, queue.buf, sizeof queue.buf);
+	thread_id_t t = thread_spawn(&worker, THREAD_NORMAL_PRIORITY, THREAD_NO_AFFINITY, 65536, (uintptr_t) &queue, "worker");
+
+	wheel = timer_wheel_create(MILLISECOND, &queue.ring, queue.sema, THREAD_NORMAL_PRIORITY, THREAD_NO_AFFINITY, "timer");
+	run(wheel, MILLISECOND, 200 * MILLISECOND);
+	timer_wheel_destroy(wheel);
+
+	while (!atomic_enqueue(&queue.ring, &stop, sizeof stop))
+		thread_yield();
+	sema_release(queue.sema, 1);
+	thread_join(t);
+	sema_destroy(queue.sema);
+
+	printf("OK\n");
+	return 0;
+}